@@ -0,0 +1,138 @@
+#!/bin/bash
+
+# Benchmarks cats against synthetic corpora and reports MB/s with
+# run-to-run spread, so changes to the scanner or the converter can be
+# judged against numbers instead of vibes.
+#
+#   ./bench.sh            warm-cache numbers, 5 runs per case
+#   RUNS=10 ./bench.sh    more runs
+#   COLD=1 ./bench.sh     drop the page cache before every run
+#                         (needs root for /proc/sys/vm/drop_caches)
+#
+# The corpus is generated once into bench_corpus/ and reused; delete the
+# directory to regenerate it.
+
+set -e
+
+RUNS=${RUNS:-5}
+COLD=${COLD:-0}
+CORPUS=${CORPUS:-bench_corpus}
+BIN=bin/cats
+
+./build.sh >/dev/null 2>&1
+
+if [ ! -d "$CORPUS" ]; then
+    echo "generating corpus in $CORPUS/ ..."
+    mkdir -p "$CORPUS/tree"
+
+    # Pure ASCII with LF endings: the no-work fast path.
+    awk 'BEGIN { for (i = 0; i < 1000000; ++i)
+        print "a quick brown fox jumps over the lazy dog number", i }' \
+        > "$CORPUS/ascii.txt"
+
+    # CRLF on every line: worst case for the CR stripper.
+    awk 'BEGIN { ORS = "\r\n"; for (i = 0; i < 1000000; ++i)
+        print "crlf line with a bit of text in it, number", i }' \
+        > "$CORPUS/crlf.txt"
+
+    # Control-character heavy, for -A.
+    awk 'BEGIN { ORS = "\r\n"; for (i = 0; i < 500000; ++i)
+        print "ctl\t\001\002 line " i "\007" }' > "$CORPUS/ctrl.txt"
+
+    # Every other line blank, for -s.
+    awk 'BEGIN { for (i = 0; i < 1000000; ++i) { print "line", i; print "" } }' \
+        > "$CORPUS/blank.txt"
+
+    if command -v iconv >/dev/null 2>&1; then
+        iconv -f UTF-8 -t UTF-16LE "$CORPUS/crlf.txt" > "$CORPUS/utf16le.txt"
+        iconv -f UTF-8 -t UTF-16BE "$CORPUS/crlf.txt" > "$CORPUS/utf16be.txt"
+    else
+        echo "iconv not found, skipping UTF-16 corpora"
+    fi
+
+    # Many small files, for startup/per-file overhead and -r/-j.
+    i=0
+    while [ "$i" -lt 500 ]; do
+        printf 'small file %d\r\nwith a second line\r\n' "$i" \
+            > "$CORPUS/tree/f$i.txt"
+        i=$((i + 1))
+    done
+fi
+
+drop_caches() {
+    if [ "$COLD" = 1 ]; then
+        sync
+        if ! echo 3 > /proc/sys/vm/drop_caches 2>/dev/null; then
+            echo "cannot drop caches (need root); rerun without COLD=1" >&2
+            exit 1
+        fi
+    fi
+}
+
+# bench <label> <bytes> <prep command or -> <command>
+# Runs <command> through sh -c RUNS times (after one warmup) and prints
+# mean MB/s with the min-max spread. <prep> runs before every timed run,
+# outside the timing (used to restore --overwrite inputs).
+bench() {
+    label=$1
+    bytes=$2
+    prep=$3
+    cmd=$4
+
+    [ "$prep" = - ] || sh -c "$prep"
+    sh -c "$cmd" > /dev/null 2>&1 || true # warmup
+
+    times=""
+    n=0
+    while [ "$n" -lt "$RUNS" ]; do
+        [ "$prep" = - ] || sh -c "$prep"
+        drop_caches
+        t0=$(date +%s%N)
+        sh -c "$cmd" > /dev/null
+        t1=$(date +%s%N)
+        times="$times $(((t1 - t0) / 1000))"
+        n=$((n + 1))
+    done
+
+    echo "$times" | awk -v label="$label" -v bytes="$bytes" '
+    {
+        min = 1e18; max = 0; sum = 0
+        for (i = 1; i <= NF; ++i) {
+            sum += $i
+            if ($i < min) min = $i
+            if ($i > max) max = $i
+        }
+        mean = sum / NF
+        mbs  = bytes / 1048576 / (mean / 1e6)
+        lo   = bytes / 1048576 / (max / 1e6)
+        hi   = bytes / 1048576 / (min / 1e6)
+        printf "%-18s %8.1f MB/s  (%.1f .. %.1f, %d runs)\n", \
+               label, mbs, lo, hi, NF
+    }'
+}
+
+size() { wc -c < "$1"; }
+
+tree_bytes=$(du -sb "$CORPUS/tree" 2>/dev/null | cut -f1)
+[ -n "$tree_bytes" ] || tree_bytes=$(find "$CORPUS/tree" -type f -exec wc -c {} + | awk 'END { print $1 }')
+
+[ "$COLD" = 1 ] && echo "cold cache:" || echo "warm cache:"
+
+bench "plain ascii"  "$(size "$CORPUS/ascii.txt")" - "$BIN $CORPUS/ascii.txt"
+bench "plain crlf"   "$(size "$CORPUS/crlf.txt")"  - "$BIN $CORPUS/crlf.txt"
+bench "stdin crlf"   "$(size "$CORPUS/crlf.txt")"  - "$BIN < $CORPUS/crlf.txt"
+bench "-n crlf"      "$(size "$CORPUS/crlf.txt")"  - "$BIN -n $CORPUS/crlf.txt"
+bench "-s blank"     "$(size "$CORPUS/blank.txt")" - "$BIN -s $CORPUS/blank.txt"
+bench "-A ctrl"      "$(size "$CORPUS/ctrl.txt")"  - "$BIN -A $CORPUS/ctrl.txt"
+
+if [ -f "$CORPUS/utf16le.txt" ]; then
+    bench "utf16le"  "$(size "$CORPUS/utf16le.txt")" - "$BIN $CORPUS/utf16le.txt"
+    bench "utf16be"  "$(size "$CORPUS/utf16be.txt")" - "$BIN $CORPUS/utf16be.txt"
+fi
+
+bench "tree -r"      "$tree_bytes" - "$BIN -r $CORPUS/tree"
+bench "tree -r -j4"  "$tree_bytes" - "$BIN -r -j4 $CORPUS/tree"
+
+bench "--overwrite"  "$(size "$CORPUS/crlf.txt")" \
+    "cp $CORPUS/crlf.txt $CORPUS/ow.tmp" "$BIN -o $CORPUS/ow.tmp"
+rm -f "$CORPUS/ow.tmp"